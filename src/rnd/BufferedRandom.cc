@@ -0,0 +1,112 @@
+/*
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * - Redistributions of source code must retain the above copyright notice, this
+ * list of conditions and the following disclaimer.
+ *
+ * - Redistributions in binary form must reproduce the above copyright notice,
+ * this list of conditions and the following disclaimer in the documentation
+ * and/or other materials provided with the distribution.
+ *
+ * - Neither the name of prim nor the names of its contributors may be used to
+ * endorse or promote products derived from this software without specific prior
+ * written permission.
+ *
+ * See the NOTICE file distributed with this work for additional information
+ * regarding copyright ownership.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ */
+#include "rnd/BufferedRandom.h"
+
+#include <cassert>
+#include <utility>
+
+namespace rnd {
+
+BufferedRandom::BufferedRandom(u64 _seed, u64 _blockSize, bool _background)
+    : Random(Engine::kBuffered, nullptr, nullptr),
+      source_(_seed),
+      front_(_blockSize),
+      back_(_blockSize),
+      background_(_background),
+      backReady_(false),
+      stop_(false) {
+  assert(_blockSize > 0);
+  fill(&front_);
+  setBlock(front_.data(), front_.data() + front_.size());
+  if (background_) {
+    producer_ = std::thread(&BufferedRandom::produce, this);
+  }
+}
+
+BufferedRandom::~BufferedRandom() {
+  if (background_) {
+    {
+      std::lock_guard<std::mutex> guard(lock_);
+      stop_ = true;
+    }
+    cond_.notify_all();
+    producer_.join();
+  }
+}
+
+void BufferedRandom::refill() {
+  if (!background_ && !backReady_) {
+    fill(&back_);
+    backReady_ = true;
+  }
+}
+
+void BufferedRandom::nextBlock() {
+  if (background_) {
+    {
+      std::unique_lock<std::mutex> guard(lock_);
+      cond_.wait(guard, [this] { return backReady_; });
+      std::swap(front_, back_);
+      backReady_ = false;
+    }
+    cond_.notify_all();
+  } else {
+    refill();
+    std::swap(front_, back_);
+    backReady_ = false;
+  }
+  setBlock(front_.data(), front_.data() + front_.size());
+}
+
+void BufferedRandom::fill(std::vector<u64>* _block) {
+  for (u64& value : *_block) {
+    value = source_.nextU64();
+  }
+}
+
+void BufferedRandom::produce() {
+  std::unique_lock<std::mutex> guard(lock_);
+  while (true) {
+    cond_.wait(guard, [this] { return stop_ || !backReady_; });
+    if (stop_) {
+      return;
+    }
+
+    // the consumer does not touch the spare block until it is marked ready
+    guard.unlock();
+    fill(&back_);
+    guard.lock();
+    backReady_ = true;
+    cond_.notify_all();
+  }
+}
+
+}  // namespace rnd
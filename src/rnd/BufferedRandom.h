@@ -0,0 +1,82 @@
+/*
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * - Redistributions of source code must retain the above copyright notice, this
+ * list of conditions and the following disclaimer.
+ *
+ * - Redistributions in binary form must reproduce the above copyright notice,
+ * this list of conditions and the following disclaimer in the documentation
+ * and/or other materials provided with the distribution.
+ *
+ * - Neither the name of prim nor the names of its contributors may be used to
+ * endorse or promote products derived from this software without specific prior
+ * written permission.
+ *
+ * See the NOTICE file distributed with this work for additional information
+ * regarding copyright ownership.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ */
+#ifndef RND_BUFFEREDRANDOM_H_
+#define RND_BUFFEREDRANDOM_H_
+
+#include <prim/prim.h>
+
+#include <condition_variable>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+#include "rnd/Random.h"
+
+namespace rnd {
+
+// this is a Random whose raw engine outputs are generated ahead of time into
+//  two blocks, all draws are made by the shared Random code so they match a
+//  Random with the same seed. the caller consumes one block while the other
+//  is refilled, either by a background producer thread or by explicit calls
+//  to refill(). seed() and derive() are not supported
+class BufferedRandom : public Random {
+ public:
+  BufferedRandom(u64 _seed, u64 _blockSize, bool _background);
+  ~BufferedRandom() override;
+  BufferedRandom(const BufferedRandom&) = delete;
+  BufferedRandom& operator=(const BufferedRandom&) = delete;
+
+  // this fills the spare block if it has been consumed, this is only needed
+  //  without a background producer, it is a no-op otherwise
+  void refill();
+
+ protected:
+  void nextBlock() override;
+
+ private:
+  void fill(std::vector<u64>* _block);
+  void produce();
+
+  Random source_;
+  std::vector<u64> front_;
+  std::vector<u64> back_;
+
+  bool background_;
+  bool backReady_;
+  bool stop_;
+  std::mutex lock_;
+  std::condition_variable cond_;
+  std::thread producer_;
+};
+
+}  // namespace rnd
+
+#endif  // RND_BUFFEREDRANDOM_H_
@@ -0,0 +1,92 @@
+/*
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * - Redistributions of source code must retain the above copyright notice, this
+ * list of conditions and the following disclaimer.
+ *
+ * - Redistributions in binary form must reproduce the above copyright notice,
+ * this list of conditions and the following disclaimer in the documentation
+ * and/or other materials provided with the distribution.
+ *
+ * - Neither the name of prim nor the names of its contributors may be used to
+ * endorse or promote products derived from this software without specific prior
+ * written permission.
+ *
+ * See the NOTICE file distributed with this work for additional information
+ * regarding copyright ownership.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ */
+#include "rnd/BufferedRandom.h"
+
+#include <vector>
+
+#include "gtest/gtest.h"
+#include "prim/prim.h"
+#include "rnd/Random.h"
+
+namespace {
+
+// Draws a mix of values through the Random interface.
+std::vector<f64> draw(rnd::Random* _gen, u64 _rounds) {
+  std::vector<f64> values;
+  std::vector<u32> shuffled({1, 2, 3, 4, 5, 6, 7, 8});
+  for (u64 r = 0; r < _rounds; r++) {
+    values.push_back(_gen->nextU64());
+    values.push_back(_gen->nextU64(1 + r % 64));
+    values.push_back(_gen->nextU64(100, 100 + r));
+    values.push_back(_gen->nextF64());
+    values.push_back(_gen->nextF64(-5.0, 5.0));
+    values.push_back(_gen->nextBool());
+    _gen->shuffle(&shuffled);
+    values.push_back(shuffled.front());
+    values.push_back(_gen->retrieve(&shuffled));
+    values.push_back(_gen->nextF32());
+    values.push_back(_gen->nextBinomial(100 + r, 0.4));
+    values.push_back(_gen->randomSetBit(0xF0F0lu));
+    f64 fills[3];
+    _gen->fillF64(fills, 3, 0.0, 1.0);
+    values.insert(values.end(), fills, fills + 3);
+  }
+  return values;
+}
+
+}  // namespace
+
+TEST(BufferedRandom, matchesRandom) {
+  const u64 kRounds = 20000;
+  const std::vector<u64> kBlockSizes({1, 7, 1024});
+  for (u64 blockSize : kBlockSizes) {
+    for (bool background : {false, true}) {
+      rnd::Random rand(0xDEADBEEF12345678lu);
+      rnd::BufferedRandom brand(0xDEADBEEF12345678lu, blockSize, background);
+      std::vector<f64> exp = draw(&rand, kRounds);
+      ASSERT_EQ(brand.engine(), rnd::Random::Engine::kBuffered);
+      std::vector<f64> act = draw(&brand, kRounds);
+      ASSERT_EQ(exp, act);
+    }
+  }
+}
+
+TEST(BufferedRandom, refill) {
+  const u64 kBlockSize = 256;
+  rnd::Random rand(1234);
+  rnd::BufferedRandom brand(1234, kBlockSize, false);
+  for (u64 r = 0; r < 100 * kBlockSize; r++) {
+    if (r % kBlockSize == 0) {
+      brand.refill();
+    }
+    ASSERT_EQ(brand.nextU64(), rand.nextU64());
+  }
+}
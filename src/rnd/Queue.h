@@ -32,9 +32,12 @@
 #define RND_QUEUE_H_
 
 #include <cstddef>
+#include <iterator>
+#include <memory>
+#include <memory_resource>
+#include <optional>
 #include <random>
 #include <set>
-#include <unordered_set>
 #include <vector>
 
 #include "prim/prim.h"
@@ -42,10 +45,44 @@
 
 namespace rnd {
 
-template <typename T>
+// this stores items contiguously, so once the capacity covers the steady state
+//  size, adding and popping do not allocate
+template <typename T, typename Allocator = std::allocator<T>>
 class Queue {
  public:
-  explicit Queue(Random* _random);
+  // this is a view that pops the items of the queue in random order as it is
+  //  iterated, items not reached before iteration stops remain in the queue
+  class Drain {
+   public:
+    class Iterator {
+     public:
+      typedef std::input_iterator_tag iterator_category;
+      typedef T value_type;
+      typedef std::ptrdiff_t difference_type;
+      typedef const T* pointer;
+      typedef const T& reference;
+
+      explicit Iterator(Queue* _queue);  // nullptr is the end iterator
+      const T& operator*() const;
+      const T* operator->() const;
+      Iterator& operator++();
+      bool operator==(const Iterator& _other) const;
+      bool operator!=(const Iterator& _other) const;
+
+     private:
+      Queue* queue_;
+      std::optional<T> item_;  // T needn't be default constructible
+    };
+
+    explicit Drain(Queue* _queue);
+    Iterator begin();
+    Iterator end();
+
+   private:
+    Queue* queue_;
+  };
+
+  explicit Queue(Random* _random, const Allocator& _allocator = Allocator());
   ~Queue();
   void add(T _item);
   void add(T _start, T _stop);
@@ -54,13 +91,28 @@ class Queue {
   void clear();
   u64 size() const;
   T pop();  // undefined if empty
-  u64 erase(T _item);
+  void popN(u64 _count, std::vector<T>* _out);  // undefined if size < _count
+  Drain drain();
+  u64 erase(T _item);  // linear in the size of the queue
+
+  void reserve(u64 _capacity);
+  void shrink_to_fit();
+  u64 capacity() const;
 
  private:
   Random* random_;
-  std::unordered_multiset<T> values_;
+  std::vector<T, Allocator> values_;
 };
 
+namespace pmr {
+
+// this queue draws its storage from a std::pmr::memory_resource, such as a
+//  std::pmr::unsynchronized_pool_resource or std::pmr::monotonic_buffer_resource
+template <typename T>
+using Queue = rnd::Queue<T, std::pmr::polymorphic_allocator<T>>;
+
+}  // namespace pmr
+
 }  // namespace rnd
 
 #include "rnd/Queue.tcc"
@@ -36,30 +36,33 @@
 #else  // RND_QUEUE_H_
 
 #include <algorithm>
+#include <cassert>
 #include <iterator>
 #include <set>
+#include <utility>
 #include <vector>
 
 namespace rnd {
 
-template <typename T>
-Queue<T>::Queue(Random* _random) : random_(_random) {}
+template <typename T, typename Allocator>
+Queue<T, Allocator>::Queue(Random* _random, const Allocator& _allocator)
+    : random_(_random), values_(_allocator) {}
 
-template <typename T>
-Queue<T>::~Queue() {}
+template <typename T, typename Allocator>
+Queue<T, Allocator>::~Queue() {}
 
-template <typename T>
-void Queue<T>::add(T _item) {
-  values_.insert(_item);
+template <typename T, typename Allocator>
+void Queue<T, Allocator>::add(T _item) {
+  values_.push_back(_item);
 }
 
-template <typename T>
-void Queue<T>::add(T _start, T _stop) {
+template <typename T, typename Allocator>
+void Queue<T, Allocator>::add(T _start, T _stop) {
   if (_stop >= _start) {
     T current = _start;
     while (true) {
       bool last = (current == _stop);
-      values_.insert(current);
+      values_.push_back(current);
       current++;
       if (last) {
         break;
@@ -68,43 +71,140 @@ void Queue<T>::add(T _start, T _stop) {
   }
 }
 
-template <typename T>
-void Queue<T>::add(const std::vector<T>& _values) {
+template <typename T, typename Allocator>
+void Queue<T, Allocator>::add(const std::vector<T>& _values) {
   for (auto it = _values.cbegin(); it != _values.cend(); ++it) {
-    values_.insert(*it);
+    values_.push_back(*it);
   }
 }
 
-template <typename T>
-void Queue<T>::add(const std::set<T>& _values) {
+template <typename T, typename Allocator>
+void Queue<T, Allocator>::add(const std::set<T>& _values) {
   for (auto it = _values.cbegin(); it != _values.cend(); ++it) {
-    values_.insert(*it);
+    values_.push_back(*it);
   }
 }
 
-template <typename T>
-void Queue<T>::clear() {
+template <typename T, typename Allocator>
+void Queue<T, Allocator>::clear() {
   values_.clear();
 }
 
-template <typename T>
-u64 Queue<T>::size() const {
+template <typename T, typename Allocator>
+u64 Queue<T, Allocator>::size() const {
   return values_.size();
 }
 
-template <typename T>
-T Queue<T>::pop() {
+template <typename T, typename Allocator>
+T Queue<T, Allocator>::pop() {
+  // moves the last item into the hole left by the chosen item
   u64 idx = random_->nextU64(0, values_.size() - 1);
-  auto it = values_.begin();
-  std::advance(it, idx);
-  T val = *it;
-  values_.erase(it);
+  T val = values_[idx];
+  values_[idx] = values_.back();
+  values_.pop_back();
   return val;
 }
 
-template <typename T>
-u64 Queue<T>::erase(T _item) {
-  return values_.erase(_item);
+template <typename T, typename Allocator>
+void Queue<T, Allocator>::popN(u64 _count, std::vector<T>* _out) {
+  // performs _count steps of Fisher-Yates from the back of the storage, the
+  //  chosen items are then truncated off together
+  assert(_count <= values_.size());
+  if (_out->capacity() < _out->size() + _count) {
+    // grows geometrically so repeated small calls stay amortized O(1)
+    _out->reserve(std::max(_out->size() + _count, 2 * _out->capacity()));
+  }
+  u64 size = values_.size();
+  for (u64 last = size; last > size - _count; last--) {
+    u64 idx = random_->nextU64(0, last - 1);
+    std::swap(values_[idx], values_[last - 1]);
+    _out->push_back(values_[last - 1]);
+  }
+  values_.erase(values_.end() - _count, values_.end());
+}
+
+template <typename T, typename Allocator>
+typename Queue<T, Allocator>::Drain Queue<T, Allocator>::drain() {
+  return Drain(this);
+}
+
+template <typename T, typename Allocator>
+u64 Queue<T, Allocator>::erase(T _item) {
+  u64 before = values_.size();
+  values_.erase(std::remove(values_.begin(), values_.end(), _item),
+                values_.end());
+  return before - values_.size();
+}
+
+template <typename T, typename Allocator>
+void Queue<T, Allocator>::reserve(u64 _capacity) {
+  values_.reserve(_capacity);
+}
+
+template <typename T, typename Allocator>
+void Queue<T, Allocator>::shrink_to_fit() {
+  values_.shrink_to_fit();
+}
+
+template <typename T, typename Allocator>
+u64 Queue<T, Allocator>::capacity() const {
+  return values_.capacity();
+}
+
+template <typename T, typename Allocator>
+Queue<T, Allocator>::Drain::Iterator::Iterator(Queue* _queue)
+    : queue_(_queue) {
+  if (queue_ != nullptr) {
+    ++(*this);
+  }
+}
+
+template <typename T, typename Allocator>
+const T& Queue<T, Allocator>::Drain::Iterator::operator*() const {
+  return *item_;
+}
+
+template <typename T, typename Allocator>
+const T* Queue<T, Allocator>::Drain::Iterator::operator->() const {
+  return &*item_;
+}
+
+template <typename T, typename Allocator>
+typename Queue<T, Allocator>::Drain::Iterator&
+Queue<T, Allocator>::Drain::Iterator::operator++() {
+  if (queue_->size() == 0) {
+    queue_ = nullptr;
+  } else {
+    item_.emplace(queue_->pop());
+  }
+  return *this;
+}
+
+template <typename T, typename Allocator>
+bool Queue<T, Allocator>::Drain::Iterator::operator==(
+    const Iterator& _other) const {
+  return queue_ == _other.queue_;
+}
+
+template <typename T, typename Allocator>
+bool Queue<T, Allocator>::Drain::Iterator::operator!=(
+    const Iterator& _other) const {
+  return queue_ != _other.queue_;
+}
+
+template <typename T, typename Allocator>
+Queue<T, Allocator>::Drain::Drain(Queue* _queue) : queue_(_queue) {}
+
+template <typename T, typename Allocator>
+typename Queue<T, Allocator>::Drain::Iterator
+Queue<T, Allocator>::Drain::begin() {
+  return Iterator(queue_);
+}
+
+template <typename T, typename Allocator>
+typename Queue<T, Allocator>::Drain::Iterator
+Queue<T, Allocator>::Drain::end() {
+  return Iterator(nullptr);
 }
 
 }  // namespace rnd
@@ -30,12 +30,25 @@
  */
 #include "rnd/Queue.h"
 
+#include <cstddef>
+#include <memory_resource>
 #include <set>
+#include <vector>
 
 #include "gtest/gtest.h"
 #include "prim/prim.h"
 #include "rnd/Random.h"
 
+namespace {
+
+// This type has no default constructor.
+struct Item {
+  explicit Item(u32 _value) : value(_value) {}
+  u32 value;
+};
+
+}  // namespace
+
 TEST(Queue, u8Full) {
   rnd::Random rand(1234);
   bool debug = false;
@@ -238,3 +251,153 @@ TEST(Queue, erase) {
   ASSERT_EQ(rq.size(), 0u);
   ASSERT_EQ(exp.size(), 0u);
 }
+
+TEST(Queue, eraseDuplicates) {
+  rnd::Random rand(1234);
+  rnd::Queue<u32> rq(&rand);
+  rq.add(std::vector<u32>({5, 6, 5, 7, 5}));
+  ASSERT_EQ(rq.erase(5), 3u);
+  ASSERT_EQ(rq.erase(5), 0u);
+  ASSERT_EQ(rq.size(), 2u);
+}
+
+TEST(Queue, reserve) {
+  rnd::Random rand(1234);
+  rnd::Queue<u32> rq(&rand);
+  rq.reserve(100);
+  u64 capacity = rq.capacity();
+  ASSERT_GE(capacity, 100u);
+  for (u32 round = 0; round < 1000; round++) {
+    rq.add(0, 99);
+    while (rq.size() > 50) {
+      rq.pop();
+    }
+    rq.clear();
+    ASSERT_EQ(rq.capacity(), capacity);
+  }
+  rq.shrink_to_fit();
+  ASSERT_EQ(rq.capacity(), 0u);
+}
+
+TEST(Queue, pmr) {
+  rnd::Random rand(1234);
+
+  // Gives the queue a fixed arena that fails on any further allocation.
+  std::byte buffer[1024];
+  std::pmr::monotonic_buffer_resource arena(buffer, sizeof(buffer),
+                                            std::pmr::null_memory_resource());
+  rnd::pmr::Queue<u32> rq(&rand, &arena);
+  rq.reserve(128);
+  std::set<u32> set;
+  for (u32 round = 0; round < 100; round++) {
+    rq.add(0, 127);
+    set.clear();
+    while (rq.size() > 0) {
+      ASSERT_TRUE(set.insert(rq.pop()).second);
+    }
+    ASSERT_EQ(set.size(), 128u);
+  }
+}
+
+TEST(Queue, popN) {
+  // Verifies popN matches repeated pops from the same seed.
+  rnd::Random rand1(1234);
+  rnd::Random rand2(1234);
+  rnd::Queue<u32> rq1(&rand1);
+  rnd::Queue<u32> rq2(&rand2);
+  rq1.add(0, 999);
+  rq2.add(0, 999);
+  std::vector<u32> out({5000});
+  rq1.popN(300, &out);
+  ASSERT_EQ(out.size(), 301u);
+  ASSERT_EQ(out.at(0), 5000u);
+  for (u32 idx = 1; idx < out.size(); idx++) {
+    ASSERT_EQ(out.at(idx), rq2.pop());
+  }
+  ASSERT_EQ(rq1.size(), 700u);
+  while (rq1.size() > 0) {
+    ASSERT_EQ(rq1.pop(), rq2.pop());
+  }
+
+  // Verifies popN can take everything.
+  rq1.add(10, 19);
+  out.clear();
+  rq1.popN(10, &out);
+  ASSERT_EQ(rq1.size(), 0u);
+  ASSERT_EQ(std::set<u32>(out.begin(), out.end()).size(), 10u);
+}
+
+TEST(Queue, popNGrowth) {
+  // Verifies appending one at a time keeps the output's geometric growth.
+  rnd::Random rand(1234);
+  rnd::Queue<u32> rq(&rand);
+  rq.add(0, 9999);
+  std::vector<u32> out;
+  u64 reallocs = 0;
+  while (rq.size() > 0) {
+    u64 capacity = out.capacity();
+    rq.popN(1, &out);
+    if (out.capacity() != capacity) {
+      reallocs++;
+    }
+  }
+  ASSERT_EQ(out.size(), 10000u);
+  ASSERT_LE(reallocs, 20u);
+}
+
+TEST(Queue, drain) {
+  rnd::Random rand(1234);
+  rnd::Queue<u32> rq(&rand);
+  rq.add(0, 999);
+  std::set<u32> set;
+  for (u32 val : rq.drain()) {
+    ASSERT_LT(val, 1000u);
+    ASSERT_TRUE(set.insert(val).second);
+  }
+  ASSERT_EQ(set.size(), 1000u);
+  ASSERT_EQ(rq.size(), 0u);
+
+  // Verifies nothing is produced from an empty queue.
+  for (u32 val : rq.drain()) {
+    (void)val;
+    ASSERT_TRUE(false);
+  }
+
+  // Verifies stopping early leaves the remaining items in the queue.
+  rq.add(0, 99);
+  set.clear();
+  for (u32 val : rq.drain()) {
+    set.insert(val);
+    if (set.size() == 40) {
+      break;
+    }
+  }
+  ASSERT_EQ(rq.size(), 60u);
+  while (rq.size() > 0) {
+    ASSERT_TRUE(set.insert(rq.pop()).second);
+  }
+  ASSERT_EQ(set.size(), 100u);
+}
+
+TEST(Queue, noDefaultConstructor) {
+  rnd::Random rand(1234);
+  rnd::Queue<Item> rq(&rand);
+  for (u32 val = 0; val < 100; val++) {
+    rq.add(Item(val));
+  }
+
+  std::vector<Item> out;
+  rq.popN(40, &out);
+  ASSERT_EQ(out.size(), 40u);
+  ASSERT_EQ(rq.size(), 60u);
+
+  std::set<u32> set;
+  for (const Item& item : out) {
+    ASSERT_TRUE(set.insert(item.value).second);
+  }
+  for (const Item& item : rq.drain()) {
+    ASSERT_TRUE(set.insert(item.value).second);
+  }
+  ASSERT_EQ(set.size(), 100u);
+  ASSERT_EQ(rq.size(), 0u);
+}
@@ -30,65 +30,596 @@
  */
 #include "rnd/Random.h"
 
+#include <algorithm>
 #include <cassert>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <iterator>
+#include <memory>
+
+#if defined(__BMI2__)
+#include <immintrin.h>
+#endif
+
+#include "rnd/Trace.h"
 
 namespace rnd {
 
-Random::Random() {}
+namespace {
+
+// this returns the index of the _k'th (0-based) set bit of the word
+u64 selectBit(u64 _word, u64 _k) {
+  assert(_k < static_cast<u64>(__builtin_popcountll(_word)));
+#if defined(__BMI2__)
+  return __builtin_ctzll(_pdep_u64(1lu << _k, _word));
+#else
+  // narrows down to the byte holding the bit, then clears the lower bits
+  u64 base = 0;
+  for (u64 width = 32; width >= 8; width >>= 1) {
+    u64 low = _word & ((1lu << width) - 1);
+    u64 count = __builtin_popcountll(low);
+    if (_k >= count) {
+      _k -= count;
+      _word >>= width;
+      base += width;
+    } else {
+      _word = low;
+    }
+  }
+  for (; _k > 0; _k--) {
+    _word &= _word - 1;
+  }
+  return base + __builtin_ctzll(_word);
+#endif
+}
+
+// this is the SplitMix64 output function
+u64 splitMix64Mix(u64 _z) {
+  _z = (_z ^ (_z >> 30)) * 0xBF58476D1CE4E5B9lu;
+  _z = (_z ^ (_z >> 27)) * 0x94D049BB133111EBlu;
+  return _z ^ (_z >> 31);
+}
+
+// this advances the SplitMix64 state and returns the next output
+u64 splitMix64(u64* _state) {
+  *_state += 0x9E3779B97F4A7C15lu;
+  return splitMix64Mix(*_state);
+}
+
+// this converts the top 53 bits of a raw draw to a f64 in [0,1)
+f64 toF64(u64 _raw) {
+  return static_cast<f64>(_raw >> 11) * 0x1.0p-53;
+}
+
+// this converts the top 24 bits of a 32-bit half draw to a f32 in [0,1)
+f32 toF32(u32 _raw) {
+  return static_cast<f32>(_raw >> 8) * 0x1.0p-24f;
+}
+
+// these scale a [0,1) value to [_min,_max), _top is the largest value below
+//  _max, which the result is clamped to since the rounding of the multiply
+//  and add can otherwise produce _max
+f64 scaleF64(f64 _unit, f64 _min, f64 _span, f64 _top) {
+  return std::min(_min + _span * _unit, _top);
+}
+
+f32 scaleF32(f32 _unit, f32 _min, f32 _span, f32 _top) {
+  return std::min(_min + _span * _unit, _top);
+}
+
+// this is the number of raw values generated per conversion pass
+const u64 kFillChunk = 256;
+
+}  // namespace
+
+Random::Random()
+    : engine_(Engine::kMt19937),
+      seed_(std::mt19937_64::default_seed),
+      mt_(std::make_unique<std::mt19937_64>()),
+      xoshiro_(),
+      blockBegin_(nullptr),
+      blockNext_(nullptr),
+      blockEnd_(nullptr),
+      recorder_(nullptr),
+      f32Bits_(0),
+      f32Ready_(false) {}
 
-Random::Random(u64 _seed) {
+Random::Random(u64 _seed) : Random(_seed, Engine::kMt19937) {}
+
+Random::Random(u64 _seed, Engine _engine)
+    : engine_(_engine),
+      seed_(0),
+      xoshiro_(),
+      blockBegin_(nullptr),
+      blockNext_(nullptr),
+      blockEnd_(nullptr),
+      recorder_(nullptr),
+      f32Bits_(0),
+      f32Ready_(false) {
+  assert(_engine == Engine::kMt19937 || _engine == Engine::kXoshiro256);
   seed(_seed);
 }
 
+Random::Random(const TraceReader* _trace)
+    : Random(Engine::kReplay, _trace->data(),
+             _trace->data() + _trace->size()) {}
+
+Random::Random(Engine _engine, const u64* _begin, const u64* _end)
+    : engine_(_engine),
+      seed_(0),
+      xoshiro_(),
+      blockBegin_(_begin),
+      blockNext_(_begin),
+      blockEnd_(_end),
+      recorder_(nullptr),
+      f32Bits_(0),
+      f32Ready_(false) {
+  assert(_engine == Engine::kReplay || _engine == Engine::kBuffered);
+}
+
+Random::Random(const Random& _other)
+    : engine_(Engine::kMt19937),
+      seed_(0),
+      xoshiro_(),
+      blockBegin_(nullptr),
+      blockNext_(nullptr),
+      blockEnd_(nullptr),
+      recorder_(nullptr),
+      f32Bits_(0),
+      f32Ready_(false) {
+  *this = _other;
+}
+
 Random::~Random() {}
 
+Random& Random::operator=(const Random& _other) {
+  assert(_other.engine_ != Engine::kBuffered);
+  if (this != &_other) {
+    engine_ = _other.engine_;
+    seed_ = _other.seed_;
+    if (_other.mt_) {
+      mt_ = std::make_unique<std::mt19937_64>(*_other.mt_);
+    } else {
+      mt_.reset();
+    }
+    std::copy(std::begin(_other.xoshiro_), std::end(_other.xoshiro_),
+              std::begin(xoshiro_));
+    blockBegin_ = _other.blockBegin_;
+    blockNext_ = _other.blockNext_;
+    blockEnd_ = _other.blockEnd_;
+    recorder_ = nullptr;  // a copy is a separate stream, it isn't recorded
+    int_dist_ = _other.int_dist_;
+    f32Bits_ = _other.f32Bits_;
+    f32Ready_ = _other.f32Ready_;
+  }
+  return *this;
+}
+
 void Random::seed(u64 _seed) {
-  std::seed_seq seq = {(u32)((_seed >> 32) & 0xFFFFFFFFlu),
-                       (u32)((_seed >> 0) & 0xFFFFFFFFlu)};
-  prng_.seed(seq);
+  seed_ = _seed;
+  f32Ready_ = false;
+  switch (engine_) {
+    case Engine::kMt19937: {
+      std::seed_seq seq = {(u32)((_seed >> 32) & 0xFFFFFFFFlu),
+                           (u32)((_seed >> 0) & 0xFFFFFFFFlu)};
+      if (mt_) {
+        mt_->seed(seq);
+      } else {
+        mt_ = std::make_unique<std::mt19937_64>(seq);
+      }
+      break;
+    }
+    case Engine::kXoshiro256: {
+      u64 state = _seed;
+      for (u64& word : xoshiro_) {
+        word = splitMix64(&state);
+      }
+      break;
+    }
+    case Engine::kReplay:
+      blockNext_ = blockBegin_;
+      break;
+    case Engine::kBuffered:
+      assert(false);
+      break;
+  }
+}
+
+Random::Engine Random::engine() const {
+  return engine_;
+}
+
+Random Random::derive(u64 _key) const {
+  assert(engine_ == Engine::kMt19937 || engine_ == Engine::kXoshiro256);
+  u64 state = seed_ ^ splitMix64Mix(_key + 0x9E3779B97F4A7C15lu);
+  return Random(splitMix64(&state), engine_);
+}
+
+void Random::record(TraceWriter* _writer) {
+  recorder_ = _writer;
 }
 
 u64 Random::nextU64() {
-  return int_dist_(prng_);
+  Source source(this);
+  return int_dist_(source);
 }
 
 u64 Random::nextU64(u64 _bits) {
   assert(_bits > 0 && _bits <= 64);
-  return int_dist_(prng_) & ((0x1 << _bits) - 1);
+  Source source(this);
+  u64 rand = int_dist_(source);
+  if (_bits < 64) {
+    rand &= (1lu << _bits) - 1;
+  }
+  return rand;
 }
 
 u64 Random::nextU64(u64 _min, u64 _max) {
   assert(_max >= _min);
+  Source source(this);
   if (_min == _max) {
     return _min;
   }
   if ((_max - _min) == U64_MAX) {
-    return int_dist_(prng_);
+    return int_dist_(source);
   }
   u64 span = _max - _min + 1;
-  u64 top = prng_.max() - prng_.max() % span;
+  u64 top = source.max() - source.max() % span;
   u64 rand;
   do {
-    rand = int_dist_(prng_);
+    rand = int_dist_(source);
   } while (rand >= top);
   rand %= span;
   return _min + rand;
 }
 
 f64 Random::nextF64() {
-  return real_dist_(prng_);
+  Source source(this);
+  return toF64(source());
 }
 
 f64 Random::nextF64(f64 _min, f64 _max) {
   assert(_max >= _min);
-  f64 r = real_dist_(prng_);
-  r *= (_max - _min);
-  r += _min;
-  return r;
+  Source source(this);
+  return scaleF64(toF64(source()), _min, _max - _min,
+                  std::nextafter(_max, _min));
+}
+
+f32 Random::nextF32() {
+  if (f32Ready_) {
+    f32Ready_ = false;
+    return toF32(f32Bits_);
+  }
+  Source source(this);
+  u64 raw = source();
+  f32Bits_ = static_cast<u32>(raw >> 32);
+  f32Ready_ = true;
+  return toF32(static_cast<u32>(raw));
+}
+
+f32 Random::nextF32(f32 _min, f32 _max) {
+  assert(_max >= _min);
+  return scaleF32(nextF32(), _min, _max - _min, std::nextafter(_max, _min));
 }
 
 bool Random::nextBool() {
-  return static_cast<bool>(int_dist_(prng_) & 0x1);
+  Source source(this);
+  return static_cast<bool>(int_dist_(source) & 0x1);
+}
+
+void Random::fillF64(f64* _values, u64 _count, f64 _min, f64 _max) {
+  assert(_max >= _min);
+  Source source(this);
+  f64 span = _max - _min;
+  f64 top = std::nextafter(_max, _min);
+  u64 raw[kFillChunk];
+  for (u64 base = 0; base < _count; base += kFillChunk) {
+    u64 chunk = std::min(kFillChunk, _count - base);
+    for (u64 idx = 0; idx < chunk; idx++) {
+      raw[idx] = source();
+    }
+    f64* values = _values + base;
+    for (u64 idx = 0; idx < chunk; idx++) {
+      values[idx] = scaleF64(toF64(raw[idx]), _min, span, top);
+    }
+  }
+}
+
+void Random::fillF32(f32* _values, u64 _count, f32 _min, f32 _max) {
+  assert(_max >= _min);
+  f32 span = _max - _min;
+  f32 top = std::nextafter(_max, _min);
+
+  // uses up the half draw left over by nextF32() first
+  if (_count > 0 && f32Ready_) {
+    *_values++ = scaleF32(toF32(f32Bits_), _min, span, top);
+    f32Ready_ = false;
+    _count--;
+  }
+
+  Source source(this);
+  u32 raw[kFillChunk * 2];
+  for (u64 base = 0; base < _count; base += kFillChunk * 2) {
+    u64 chunk = std::min(kFillChunk * 2, _count - base);
+    for (u64 idx = 0; idx < chunk; idx += 2) {
+      u64 draw = source();
+      raw[idx] = static_cast<u32>(draw);
+      raw[idx + 1] = static_cast<u32>(draw >> 32);
+    }
+    f32* values = _values + base;
+    for (u64 idx = 0; idx < chunk; idx++) {
+      values[idx] = scaleF32(toF32(raw[idx]), _min, span, top);
+    }
+
+    // keeps the unused half of an odd final draw for nextF32()
+    if (chunk % 2 == 1) {
+      f32Bits_ = raw[chunk];
+      f32Ready_ = true;
+    }
+  }
+}
+
+u64 Random::nextBinomial(u64 _n, f64 _p) {
+  assert(_p >= 0.0 && _p <= 1.0);
+  if (_n == 0 || _p <= 0.0) {
+    return 0;
+  }
+  if (_p >= 1.0) {
+    return _n;
+  }
+
+  // draws the number of failures when successes are more likely
+  f64 p = std::min(_p, 1.0 - _p);
+  u64 count;
+  if (_n * p < 30.0) {
+    count = binomialInversion(_n, p);
+  } else {
+    count = binomialBtpe(_n, p);
+  }
+  return (_p > 0.5) ? _n - count : count;
+}
+
+void Random::nextBinomial(const std::vector<u64>& _n,
+                          const std::vector<f64>& _p,
+                          std::vector<u64>* _values) {
+  assert(_n.size() == _p.size());
+  _values->resize(_n.size());
+  for (u64 idx = 0; idx < _n.size(); idx++) {
+    (*_values)[idx] = nextBinomial(_n[idx], _p[idx]);
+  }
+}
+
+void Random::multinomial(u64 _n, const std::vector<f64>& _probs,
+                         std::vector<u64>* _counts) {
+  _counts->assign(_probs.size(), 0);
+  f64 mass = 0.0;
+  u64 last = _probs.size();
+  for (u64 idx = 0; idx < _probs.size(); idx++) {
+    assert(_probs[idx] >= 0.0);
+    mass += _probs[idx];
+    if (_probs[idx] > 0.0) {
+      last = idx;
+    }
+  }
+  assert(last < _probs.size());
+
+  // each bin takes a binomial share of what the previous bins left, the last
+  //  positive bin takes the remainder
+  u64 remaining = _n;
+  for (u64 idx = 0; idx < last && remaining > 0; idx++) {
+    f64 p = std::min(_probs[idx] / mass, 1.0);
+    u64 count = nextBinomial(remaining, p);
+    (*_counts)[idx] = count;
+    remaining -= count;
+    mass -= _probs[idx];
+  }
+  (*_counts)[last] = remaining;
+}
+
+u64 Random::randomSetBit(u64 _mask) {
+  assert(_mask != 0);
+  u64 count = __builtin_popcountll(_mask);
+  return selectBit(_mask, nextU64(0, count - 1));
+}
+
+u64 Random::randomSetBit(const u64* _words, u64 _numWords) {
+  u64 count = 0;
+  for (u64 w = 0; w < _numWords; w++) {
+    count += __builtin_popcountll(_words[w]);
+  }
+  assert(count > 0);
+  u64 k = nextU64(0, count - 1);
+  for (u64 w = 0; w < _numWords; w++) {
+    u64 wcount = __builtin_popcountll(_words[w]);
+    if (k < wcount) {
+      return w * 64 + selectBit(_words[w], k);
+    }
+    k -= wcount;
+  }
+  assert(false);
+  return 0;
+}
+
+u64 Random::randomWeightedSetBit(u64 _mask,
+                                 const std::vector<f64>& _weights) {
+  assert(_mask != 0);
+  f64 total = 0;
+  for (u64 bits = _mask; bits != 0; bits &= bits - 1) {
+    u64 idx = __builtin_ctzll(bits);
+    assert(idx < _weights.size() && _weights[idx] >= 0);
+    total += _weights[idx];
+  }
+  assert(total > 0);
+
+  // walks the set bits until the target is crossed, the last positively
+  //  weighted bit absorbs any floating point round off
+  f64 target = nextF64() * total;
+  u64 last = 64;
+  for (u64 bits = _mask; bits != 0; bits &= bits - 1) {
+    u64 idx = __builtin_ctzll(bits);
+    if (_weights[idx] > 0) {
+      last = idx;
+      if (target < _weights[idx]) {
+        return idx;
+      }
+      target -= _weights[idx];
+    }
+  }
+  return last;
+}
+
+void Random::nextBlock() {
+  // a replay only has the one block, running past it is a usage error that
+  //  must not turn into reading past the end of the mapping
+  fprintf(stderr, "rnd: replay trace exhausted after %lu values\n",
+          static_cast<u64>(blockEnd_ - blockBegin_));
+  abort();
+}
+
+void Random::setBlock(const u64* _begin, const u64* _end) {
+  assert(_begin < _end);
+  blockBegin_ = _begin;
+  blockNext_ = _begin;
+  blockEnd_ = _end;
+}
+
+void Random::recordValue(u64 _value) {
+  recorder_->write(_value);
+}
+
+u64 Random::binomialInversion(u64 _n, f64 _p) {
+  // walks up the cumulative distribution from 0, restarting in the
+  //  vanishingly rare case that round off carries it past the useful bound
+  f64 q = 1.0 - _p;
+  f64 qn = std::exp(_n * std::log1p(-_p));
+  f64 np = _n * _p;
+  f64 bound = std::min(static_cast<f64>(_n), np + 10.0 * std::sqrt(np * q + 1));
+  u64 x = 0;
+  f64 px = qn;
+  f64 u = nextF64();
+  while (u > px) {
+    x++;
+    if (x > bound) {
+      x = 0;
+      px = qn;
+      u = nextF64();
+    } else {
+      u -= px;
+      px = ((_n - x + 1) * _p * px) / (x * q);
+    }
+  }
+  return x;
+}
+
+u64 Random::binomialBtpe(u64 _n, f64 _p) {
+  // this is algorithm BTPE from Kachitvichyanukul and Schmeiser, "Binomial
+  //  random variate generation", Communications of the ACM, 1988
+  f64 n = static_cast<f64>(_n);
+  f64 r = _p;
+  f64 q = 1.0 - r;
+  f64 fm = n * r + r;
+  f64 m = std::floor(fm);
+  f64 nrq = n * r * q;
+  f64 p1 = std::floor(2.195 * std::sqrt(nrq) - 4.6 * q) + 0.5;
+  f64 xm = m + 0.5;
+  f64 xl = xm - p1;
+  f64 xr = xm + p1;
+  f64 c = 0.134 + 20.5 / (15.3 + m);
+  f64 a = (fm - xl) / (fm - xl * r);
+  f64 laml = a * (1.0 + a / 2.0);
+  a = (xr - fm) / (xr * q);
+  f64 lamr = a * (1.0 + a / 2.0);
+  f64 p2 = p1 * (1.0 + 2.0 * c);
+  f64 p3 = p2 + c / laml;
+  f64 p4 = p3 + c / lamr;
+
+  while (true) {
+    f64 u = nextF64() * p4;
+    f64 v = nextF64();
+    f64 y;
+    if (u <= p1) {
+      // triangular region, always accepted
+      return static_cast<u64>(std::floor(xm - p1 * v + u));
+    } else if (u <= p2) {
+      // parallelogram region
+      f64 x = xl + (u - p1) / c;
+      v = v * c + 1.0 - std::abs(m - x + 0.5) / p1;
+      if (v > 1.0) {
+        continue;
+      }
+      y = std::floor(x);
+    } else if (u <= p3) {
+      // left exponential tail
+      y = std::floor(xl + std::log(v) / laml);
+      if (y < 0.0) {
+        continue;
+      }
+      v = v * (u - p2) * laml;
+    } else {
+      // right exponential tail
+      y = std::floor(xr - std::log(v) / lamr);
+      if (y > n) {
+        continue;
+      }
+      v = v * (u - p3) * lamr;
+    }
+
+    f64 k = std::abs(y - m);
+    if (k <= 20.0 || k >= nrq / 2.0 - 1.0) {
+      // evaluates f(y)/f(m) explicitly
+      f64 s = r / q;
+      a = s * (n + 1.0);
+      f64 f = 1.0;
+      if (m < y) {
+        for (f64 i = m + 1.0; i <= y; i += 1.0) {
+          f *= (a / i - s);
+        }
+      } else if (m > y) {
+        for (f64 i = y + 1.0; i <= m; i += 1.0) {
+          f /= (a / i - s);
+        }
+      }
+      if (v <= f) {
+        return static_cast<u64>(y);
+      }
+      continue;
+    }
+
+    // squeezes using the normal approximation, then does the final
+    //  acceptance test with Stirling's formula
+    f64 rho = (k / nrq) * ((k * (k / 3.0 + 0.625) + 1.0 / 6.0) / nrq + 0.5);
+    f64 t = -k * k / (2.0 * nrq);
+    f64 logV = std::log(v);
+    if (logV < t - rho) {
+      return static_cast<u64>(y);
+    }
+    if (logV > t + rho) {
+      continue;
+    }
+    f64 x1 = y + 1.0;
+    f64 f1 = m + 1.0;
+    f64 z = n + 1.0 - m;
+    f64 w = n - y + 1.0;
+    f64 x2 = x1 * x1;
+    f64 f2 = f1 * f1;
+    f64 z2 = z * z;
+    f64 w2 = w * w;
+    f64 bound =
+        xm * std::log(f1 / x1) + (n - m + 0.5) * std::log(z / w) +
+        (y - m) * std::log(w * r / (x1 * q)) +
+        (13860.0 - (462.0 - (132.0 - (99.0 - 140.0 / f2) / f2) / f2) / f2) /
+            f1 / 166320.0 +
+        (13860.0 - (462.0 - (132.0 - (99.0 - 140.0 / z2) / z2) / z2) / z2) /
+            z / 166320.0 +
+        (13860.0 - (462.0 - (132.0 - (99.0 - 140.0 / x2) / x2) / x2) / x2) /
+            x1 / 166320.0 +
+        (13860.0 - (462.0 - (132.0 - (99.0 - 140.0 / w2) / w2) / w2) / w2) /
+            w / 166320.0;
+    if (logV <= bound) {
+      return static_cast<u64>(y);
+    }
+  }
 }
 
 }  // namespace rnd
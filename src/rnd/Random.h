@@ -33,23 +33,108 @@
 
 #include <prim/prim.h>
 
+#include <bitset>
+#include <memory>
 #include <random>
+#include <vector>
 
 namespace rnd {
 
+class TraceReader;
+class TraceWriter;
+
 class Random {
  public:
+  // this selects the engine that generates the raw 64-bit values
+  enum class Engine : u8 {
+    // std::mt19937_64 seeded through std::seed_seq, this is the default, its
+    //  2.5 KB of state is allocated separately from the Random
+    kMt19937,
+    // xoshiro256** seeded through SplitMix64, its 32 bytes of state are held
+    //  inline so the Random makes no allocation and seeds in a few ns, which
+    //  suits short-lived per-entity generators
+    kXoshiro256,
+    // replays the values of a TraceReader, created with Random(_trace)
+    kReplay,
+    // serves the pre-generated blocks of a BufferedRandom
+    kBuffered
+  };
+
   Random();
   explicit Random(u64 _seed);
-  ~Random();
+  Random(u64 _seed, Engine _engine);  // _engine can't be kReplay/kBuffered
+  // this replays the trace from its start, the trace must outlive the Random
+  //  and must hold every value that will be drawn
+  explicit Random(const TraceReader* _trace);
+  // these copy the full engine state, moves also copy so the source stays
+  //  usable, _other can't be kBuffered
+  Random(const Random& _other);
+  virtual ~Random();
+  Random& operator=(const Random& _other);
+
+  // for kReplay this rewinds to the start of the trace
+  //  this is not supported for kBuffered
   void seed(u64 _seed);
+  Engine engine() const;
+
+  // this creates a child generator from this generator's seed and the key
+  //  using the same engine, this does not consume from this generator
+  //  this is not supported for kReplay or kBuffered
+  Random derive(u64 _key) const;
+
+  // this streams every raw engine output to the writer until it is called
+  //  again with nullptr, the writer must outlive the recording. copies of a
+  //  recording Random start without a recorder
+  void record(TraceWriter* _writer);
+
   u64 nextU64();
   u64 nextU64(u64 _bits);
   u64 nextU64(u64 _min, u64 _max);
-  f64 nextF64();
+  f64 nextF64();  // this fills all 53 mantissa bits, result is in [0,1)
   f64 nextF64(f64 _min, f64 _max);  // _max is exclusive
+  f32 nextF32();  // this yields two values per 64-bit draw, result is in [0,1)
+  f32 nextF32(f32 _min, f32 _max);  // _max is exclusive
   bool nextBool();
 
+  // these fill an array with uniform values in [_min,_max), generation and
+  //  conversion are done in separate passes so the conversion vectorizes
+  void fillF64(f64* _values, u64 _count, f64 _min, f64 _max);
+  void fillF32(f32* _values, u64 _count, f32 _min, f32 _max);
+
+  // this returns the number of successes in _n independent trials that each
+  //  succeed with probability _p, this takes O(1) expected time by using
+  //  inversion when _n*_p is small and BTPE otherwise
+  u64 nextBinomial(u64 _n, f64 _p);
+
+  // this draws a binomial for each (_n[i], _p[i]) pair into _values[i]
+  void nextBinomial(const std::vector<u64>& _n, const std::vector<f64>& _p,
+                    std::vector<u64>* _values);
+
+  // this distributes _n items across bins with the given probabilities, the
+  //  probabilities are normalized by their sum, this takes one binomial draw
+  //  per bin regardless of _n
+  void multinomial(u64 _n, const std::vector<f64>& _probs,
+                   std::vector<u64>* _counts);
+
+  // this returns the index of a uniformly chosen set bit of the mask
+  //  the mask must have at least one bit set
+  u64 randomSetBit(u64 _mask);
+
+  // this returns the index of a uniformly chosen set bit across a multi-word
+  //  mask, word 0 holds bits [0,63], word 1 holds bits [64,127], etc.
+  //  at least one bit must be set
+  u64 randomSetBit(const u64* _words, u64 _numWords);
+
+  // this returns the index of a uniformly chosen set bit of the bitset
+  //  at least one bit must be set
+  template <size_t N>
+  u64 randomSetBit(const std::bitset<N>& _mask);
+
+  // this returns the index of a set bit of the mask chosen with probability
+  //  proportional to its weight, where _weights is indexed by bit position
+  //  at least one set bit must have a positive weight
+  u64 randomWeightedSetBit(u64 _mask, const std::vector<f64>& _weights);
+
   // this shuffle the region of a container
   //  only works with RandomAccessIterators (e.g., vector, deque)
   template <typename Iterator>
@@ -71,10 +156,51 @@ class Random {
   template <typename Container>
   typename Container::value_type remove(Container* _container);
 
+ protected:
+  // this serves raw values from [_begin,_end), calling nextBlock() each time
+  //  the range runs out
+  Random(Engine _engine, const u64* _begin, const u64* _end);
+
+  // this is called when the block range runs out, it must call setBlock()
+  //  with a non-empty range
+  virtual void nextBlock();
+  void setBlock(const u64* _begin, const u64* _end);
+
  private:
-  std::mt19937_64 prng_;
+  // this adapts whichever engine is selected into a uniform random bit
+  //  generator for the standard distributions and algorithms
+  class Source {
+   public:
+    typedef u64 result_type;
+    explicit Source(Random* _random);
+    static constexpr u64 min() {
+      return 0;
+    }
+    static constexpr u64 max() {
+      return U64_MAX;
+    }
+    u64 operator()();
+
+   private:
+    Random* random_;
+  };
+
+  u64 nextXoshiro256();
+  void recordValue(u64 _value);
+  u64 binomialInversion(u64 _n, f64 _p);  // _p <= 0.5
+  u64 binomialBtpe(u64 _n, f64 _p);  // _p <= 0.5
+
+  Engine engine_;
+  u64 seed_;
+  std::unique_ptr<std::mt19937_64> mt_;  // only allocated for kMt19937
+  u64 xoshiro_[4];
+  const u64* blockBegin_;
+  const u64* blockNext_;
+  const u64* blockEnd_;
+  TraceWriter* recorder_;
   std::uniform_int_distribution<u64> int_dist_;  // this defaults to [0,2^64-1]
-  std::uniform_real_distribution<f64> real_dist_;  // this defaults to [0,1)
+  u32 f32Bits_;  // the unused half of the last draw made by nextF32()
+  bool f32Ready_;
 };
 
 }  // namespace rnd
@@ -36,17 +36,70 @@
 #else  // RND_RANDOM_H_
 
 #include <algorithm>
+#include <bitset>
 
 namespace rnd {
 
+inline Random::Source::Source(Random* _random) : random_(_random) {}
+
+inline u64 Random::Source::operator()() {
+  u64 value;
+  if (random_->engine_ == Engine::kMt19937) {
+    value = (*random_->mt_)();
+  } else if (random_->engine_ == Engine::kXoshiro256) {
+    value = random_->nextXoshiro256();
+  } else {
+    if (random_->blockNext_ == random_->blockEnd_) {
+      random_->nextBlock();
+    }
+    value = *random_->blockNext_++;
+  }
+  if (random_->recorder_ != nullptr) {
+    random_->recordValue(value);
+  }
+  return value;
+}
+
+inline u64 Random::nextXoshiro256() {
+  u64 result = xoshiro_[1] * 5;
+  result = ((result << 7) | (result >> 57)) * 9;
+  u64 t = xoshiro_[1] << 17;
+  xoshiro_[2] ^= xoshiro_[0];
+  xoshiro_[3] ^= xoshiro_[1];
+  xoshiro_[1] ^= xoshiro_[2];
+  xoshiro_[0] ^= xoshiro_[3];
+  xoshiro_[2] ^= t;
+  xoshiro_[3] = (xoshiro_[3] << 45) | (xoshiro_[3] >> 19);
+  return result;
+}
+
 template <typename Iterator>
 void Random::shuffle(Iterator _first, Iterator _last) {
-  std::shuffle(_first, _last, prng_);
+  Source source(this);
+  std::shuffle(_first, _last, source);
 }
 
 template <typename Container>
 void Random::shuffle(Container* _container) {
-  std::shuffle(_container->begin(), _container->end(), prng_);
+  Source source(this);
+  std::shuffle(_container->begin(), _container->end(), source);
+}
+
+template <size_t N>
+u64 Random::randomSetBit(const std::bitset<N>& _mask) {
+  if constexpr (N <= 64) {
+    return randomSetBit(static_cast<u64>(_mask.to_ullong()));
+  } else {
+    // splits the bitset into 64-bit words
+    const std::bitset<N> kWordMask(U64_MAX);
+    u64 words[(N + 63) / 64];
+    std::bitset<N> rem = _mask;
+    for (u64 w = 0; w < (N + 63) / 64; w++) {
+      words[w] = static_cast<u64>((rem & kWordMask).to_ullong());
+      rem >>= 64;
+    }
+    return randomSetBit(words, (N + 63) / 64);
+  }
 }
 
 template <typename Container>
@@ -30,12 +30,14 @@
  */
 #include "rnd/Random.h"
 
+#include <bitset>
 #include <cmath>
 #include <ctime>
 #include <deque>
 #include <list>
 #include <map>
 #include <set>
+#include <string>
 #include <unordered_map>
 #include <unordered_set>
 #include <utility>
@@ -43,6 +45,7 @@
 
 #include "gtest/gtest.h"
 #include "prim/prim.h"
+#include "rnd/Trace.h"
 
 TEST(Random, seed) {
   const u64 kRands = 1000;
@@ -115,7 +118,9 @@ TEST(Random, bits_range) {
       rnd::Random rand(seed);
       for (u64 r = 0; r < kRounds; r++) {
         u64 value = rand.nextU64(bits);
-        ASSERT_LE(value, 0x1 << bits);
+        if (bits < 64) {
+          ASSERT_LT(value, 1lu << bits);
+        }
       }
     }
   }
@@ -373,3 +378,349 @@ TEST(Random, removeDist) {
     ASSERT_NEAR(counts.at(c), kRounds / 4.0, 0.001 * kRounds);
   }
 }
+
+TEST(Random, randomSetBit) {
+  rnd::Random rnd(12345678);
+
+  // Verifies single bit masks always return that bit.
+  for (u64 bit = 0; bit < 64; bit++) {
+    ASSERT_EQ(rnd.randomSetBit(1lu << bit), bit);
+  }
+
+  // Verifies the choice is uniform across the set bits.
+  const u64 kMask = 0x8000100000F00013lu;
+  const u64 kRounds = 1000000;
+  std::vector<u64> counts(64, 0);
+  for (u64 r = 0; r < kRounds; r++) {
+    u64 bit = rnd.randomSetBit(kMask);
+    ASSERT_TRUE((kMask >> bit) & 0x1);
+    counts.at(bit)++;
+  }
+  f64 exp = static_cast<f64>(kRounds) / __builtin_popcountll(kMask);
+  for (u64 bit = 0; bit < 64; bit++) {
+    if ((kMask >> bit) & 0x1) {
+      ASSERT_NEAR(counts.at(bit), exp, 0.01 * exp);
+    } else {
+      ASSERT_EQ(counts.at(bit), 0u);
+    }
+  }
+}
+
+TEST(Random, randomSetBitMultiWord) {
+  rnd::Random rnd(12345678);
+
+  const u64 kRounds = 1000000;
+  std::bitset<200> mask;
+  mask.set(3);
+  mask.set(64);
+  mask.set(127);
+  mask.set(150);
+  mask.set(199);
+  std::vector<u64> counts(200, 0);
+  for (u64 r = 0; r < kRounds; r++) {
+    u64 bit = rnd.randomSetBit(mask);
+    ASSERT_TRUE(mask.test(bit));
+    counts.at(bit)++;
+  }
+  f64 exp = static_cast<f64>(kRounds) / mask.count();
+  for (u64 bit = 0; bit < 200; bit++) {
+    if (mask.test(bit)) {
+      ASSERT_NEAR(counts.at(bit), exp, 0.01 * exp);
+    }
+  }
+
+  // Verifies small bitsets and raw words agree on the chosen bit.
+  std::bitset<16> small(0x0500);
+  u64 words[2] = {0, 0x0500};
+  for (u64 r = 0; r < 1000; r++) {
+    u64 bit = rnd.randomSetBit(small);
+    ASSERT_TRUE(bit == 8 || bit == 10);
+    bit = rnd.randomSetBit(words, 2);
+    ASSERT_TRUE(bit == 72 || bit == 74);
+  }
+}
+
+TEST(Random, randomWeightedSetBit) {
+  rnd::Random rnd(12345678);
+
+  std::vector<f64> weights(64, 0.0);
+  weights.at(1) = 1.0;
+  weights.at(5) = 3.0;
+  weights.at(9) = 100.0;  // not in the mask
+  weights.at(40) = 4.0;
+  const u64 kMask = (1lu << 1) | (1lu << 5) | (1lu << 7) | (1lu << 40);
+  const u64 kRounds = 1000000;
+  std::vector<u64> counts(64, 0);
+  for (u64 r = 0; r < kRounds; r++) {
+    counts.at(rnd.randomWeightedSetBit(kMask, weights))++;
+  }
+  ASSERT_EQ(counts.at(7), 0u);
+  ASSERT_EQ(counts.at(9), 0u);
+  ASSERT_NEAR(counts.at(1), kRounds * 0.125, 0.005 * kRounds);
+  ASSERT_NEAR(counts.at(5), kRounds * 0.375, 0.005 * kRounds);
+  ASSERT_NEAR(counts.at(40), kRounds * 0.5, 0.005 * kRounds);
+}
+
+TEST(Random, xoshiro256) {
+  const u64 kBkts = 100;
+  const u64 kRounds = 10000000;
+
+  // Verifies seeding reproduces the same values.
+  rnd::Random rand(0xDEADBEEF12345678lu, rnd::Random::Engine::kXoshiro256);
+  ASSERT_EQ(rand.engine(), rnd::Random::Engine::kXoshiro256);
+  std::vector<u64> values;
+  for (u64 r = 0; r < 100; r++) {
+    values.push_back(rand.nextU64());
+  }
+  rand.seed(0xDEADBEEF12345678lu);
+  for (u64 r = 0; r < 100; r++) {
+    ASSERT_EQ(rand.nextU64(), values.at(r));
+  }
+
+  // Verifies the engine differs from the default one.
+  rnd::Random mt(0xDEADBEEF12345678lu);
+  ASSERT_EQ(mt.engine(), rnd::Random::Engine::kMt19937);
+  ASSERT_NE(mt.nextU64(), values.at(0));
+
+  // Verifies the distribution is uniform.
+  std::vector<u64> buckets(kBkts, 0);
+  for (u64 r = 0; r < kRounds; r++) {
+    buckets.at(rand.nextU64(0, kBkts - 1))++;
+  }
+  for (u64 b = 0; b < kBkts; b++) {
+    ASSERT_NEAR(buckets.at(b), kRounds / kBkts, 0.01 * kRounds / kBkts);
+  }
+}
+
+TEST(Random, derive) {
+  for (rnd::Random::Engine engine : {rnd::Random::Engine::kMt19937,
+                                     rnd::Random::Engine::kXoshiro256}) {
+    rnd::Random parent1(1234, engine);
+    rnd::Random parent2(1234, engine);
+
+    // Verifies deriving does not consume from the parent.
+    rnd::Random child1 = parent1.derive(7);
+    ASSERT_EQ(child1.engine(), engine);
+    ASSERT_EQ(parent1.nextU64(), parent2.nextU64());
+
+    // Verifies children depend only on the parent seed and the key.
+    rnd::Random child2 = parent2.derive(7);
+    rnd::Random child3 = parent2.derive(8);
+    rnd::Random child4 = rnd::Random(1235, engine).derive(7);
+    u64 value1 = child1.nextU64();
+    ASSERT_EQ(value1, child2.nextU64());
+    ASSERT_NE(value1, child3.nextU64());
+    ASSERT_NE(value1, child4.nextU64());
+
+    // Verifies reseeding the parent changes its children.
+    parent1.seed(99);
+    ASSERT_NE(parent1.derive(7).nextU64(), value1);
+  }
+}
+
+TEST(Random, binomialDist) {
+  const u64 kRounds = 2000000;
+  // Covers inversion, BTPE (both squeeze paths), and p > 0.5 flipping.
+  const std::vector<std::pair<u64, f64> > kParams(
+      {{50, 0.1}, {100, 0.4}, {200, 0.85}, {1000, 0.5}});
+  for (const auto& param : kParams) {
+    u64 n = param.first;
+    f64 p = param.second;
+    rnd::Random rand(0xDEADBEEF12345678lu);
+    std::vector<u64> counts(n + 1, 0);
+    for (u64 r = 0; r < kRounds; r++) {
+      u64 value = rand.nextBinomial(n, p);
+      ASSERT_LE(value, n);
+      counts.at(value)++;
+    }
+
+    // Compares against the exact probability mass function.
+    for (u64 k = 0; k <= n; k++) {
+      f64 log_pmf = std::lgamma(n + 1.0) - std::lgamma(k + 1.0) -
+                    std::lgamma(n - k + 1.0) + k * std::log(p) +
+                    (n - k) * std::log1p(-p);
+      f64 exp_ratio = std::exp(log_pmf);
+      f64 act_ratio = static_cast<f64>(counts.at(k)) / kRounds;
+      ASSERT_NEAR(act_ratio, exp_ratio, 0.0015);
+    }
+  }
+}
+
+TEST(Random, binomialMoments) {
+  const u64 kRounds = 200000;
+  const std::vector<std::pair<u64, f64> > kParams(
+      {{1000000000, 0.3}, {1000000, 0.00001}, {1000000, 0.99999}});
+  rnd::Random rand(12345678);
+  for (const auto& param : kParams) {
+    u64 n = param.first;
+    f64 p = param.second;
+    f64 sum = 0;
+    f64 sum2 = 0;
+    for (u64 r = 0; r < kRounds; r++) {
+      // Offsets by the expected mean to keep the sums precise.
+      f64 value = rand.nextBinomial(n, p) - n * p;
+      sum += value;
+      sum2 += value * value;
+    }
+    f64 mean = sum / kRounds;
+    f64 var = sum2 / kRounds - mean * mean;
+    f64 exp_var = n * p * (1 - p);
+    ASSERT_NEAR(mean, 0.0, 5 * std::sqrt(exp_var / kRounds));
+    ASSERT_NEAR(var, exp_var, 0.02 * exp_var);
+  }
+
+  // Verifies the edge cases and the bulk version.
+  ASSERT_EQ(rand.nextBinomial(0, 0.5), 0u);
+  ASSERT_EQ(rand.nextBinomial(100, 0.0), 0u);
+  ASSERT_EQ(rand.nextBinomial(100, 1.0), 100u);
+  std::vector<u64> values;
+  rand.nextBinomial({10, 0, 20}, {1.0, 0.5, 0.0}, &values);
+  ASSERT_EQ(values, std::vector<u64>({10, 0, 0}));
+}
+
+TEST(Random, multinomial) {
+  const u64 kItems = 1000000;
+  const u64 kRounds = 1000;
+  const std::vector<f64> kProbs({2.0, 0.0, 1.0, 5.0, 2.0, 0.0});
+  rnd::Random rand(12345678);
+  std::vector<f64> sums(kProbs.size(), 0.0);
+  std::vector<u64> counts;
+  for (u64 r = 0; r < kRounds; r++) {
+    rand.multinomial(kItems, kProbs, &counts);
+    ASSERT_EQ(counts.size(), kProbs.size());
+    u64 total = 0;
+    for (u64 b = 0; b < counts.size(); b++) {
+      total += counts.at(b);
+      sums.at(b) += counts.at(b);
+    }
+    ASSERT_EQ(total, kItems);
+    ASSERT_EQ(counts.at(1), 0u);
+    ASSERT_EQ(counts.at(5), 0u);
+  }
+  for (u64 b = 0; b < kProbs.size(); b++) {
+    f64 exp = kItems * kProbs.at(b) / 10.0;
+    ASSERT_NEAR(sums.at(b) / kRounds, exp, 0.001 * kItems);
+  }
+}
+
+TEST(Random, f32) {
+  const u64 kBkts = 1000;
+  const u64 kRounds = 10000000;
+  std::vector<u64> buckets(kBkts, 0);
+  rnd::Random rand(0xDEADBEEF12345678lu);
+  for (u64 r = 0; r < kRounds; r++) {
+    f32 value = rand.nextF32();
+    ASSERT_GE(value, 0.0f);
+    ASSERT_LT(value, 1.0f);
+    buckets.at(static_cast<u64>(value * kBkts))++;
+  }
+  for (u64 b = 0; b < kBkts; b++) {
+    ASSERT_NEAR(buckets.at(b), kRounds / kBkts, 0.05 * kRounds / kBkts);
+  }
+
+  // Verifies two floats are taken from each 64-bit draw.
+  rnd::Random rand1(1234);
+  rnd::Random rand2(1234);
+  u64 raw = rand2.nextU64();
+  ASSERT_EQ(rand1.nextF32(), (static_cast<u32>(raw) >> 8) * 0x1.0p-24f);
+  ASSERT_EQ(rand1.nextF32(), (raw >> 40) * 0x1.0p-24f);
+  ASSERT_EQ(rand1.nextU64(), rand2.nextU64());
+}
+
+TEST(Random, f64Bits) {
+  // Verifies values use the top 53 bits of each draw.
+  rnd::Random rand1(1234);
+  rnd::Random rand2(1234);
+  for (u64 r = 0; r < 1000; r++) {
+    ASSERT_EQ(rand1.nextF64(), (rand2.nextU64() >> 11) * 0x1.0p-53);
+  }
+}
+
+TEST(Random, fill) {
+  const u64 kCount = 1001;
+  rnd::Random rand1(1234);
+  rnd::Random rand2(1234);
+
+  // Verifies bulk fills match single draws from the same seed.
+  std::vector<f64> f64s(kCount);
+  rand1.fillF64(f64s.data(), kCount, -2.0, 3.0);
+  for (u64 idx = 0; idx < kCount; idx++) {
+    ASSERT_EQ(f64s.at(idx), rand2.nextF64(-2.0, 3.0));
+    ASSERT_GE(f64s.at(idx), -2.0);
+    ASSERT_LT(f64s.at(idx), 3.0);
+  }
+
+  // Verifies the half draws carry between bulk fills and single draws.
+  std::vector<f32> f32s(kCount);
+  ASSERT_EQ(rand1.nextF32(), rand2.nextF32());
+  rand1.fillF32(f32s.data(), kCount, 10.0f, 20.0f);
+  for (u64 idx = 0; idx < kCount; idx++) {
+    ASSERT_EQ(f32s.at(idx), rand2.nextF32(10.0f, 20.0f));
+    ASSERT_GE(f32s.at(idx), 10.0f);
+    ASSERT_LT(f32s.at(idx), 20.0f);
+  }
+  rand1.fillF32(f32s.data(), kCount, 0.0f, 1.0f);
+  for (u64 idx = 0; idx < kCount; idx++) {
+    ASSERT_EQ(f32s.at(idx), rand2.nextF32());
+  }
+  ASSERT_EQ(rand1.nextF32(), rand2.nextF32());
+  ASSERT_EQ(rand1.nextU64(), rand2.nextU64());
+}
+
+TEST(Random, copy) {
+  // Verifies the engine state isn't held inline.
+  ASSERT_LE(sizeof(rnd::Random), 160u);
+
+  for (rnd::Random::Engine engine : {rnd::Random::Engine::kMt19937,
+                                     rnd::Random::Engine::kXoshiro256}) {
+    // Verifies copies continue the same stream independently.
+    rnd::Random rand1(1234, engine);
+    rand1.nextU64();
+    rnd::Random rand2(rand1);
+    rnd::Random rand3(99);
+    rand3 = rand1;
+    u64 value = rand1.nextU64();
+    ASSERT_EQ(rand2.nextU64(), value);
+    ASSERT_EQ(rand3.nextU64(), value);
+    ASSERT_EQ(rand1.nextU64(), rand2.nextU64());
+
+    // Verifies moved-from generators remain usable.
+    rnd::Random rand4(std::move(rand1));
+    rnd::Random rand5(1);
+    rand5 = std::move(rand2);
+    value = rand4.nextU64();
+    ASSERT_EQ(rand5.nextU64(), value);
+    ASSERT_EQ(rand1.nextU64(), value);
+    ASSERT_EQ(rand2.nextU64(), value);
+  }
+}
+
+TEST(Random, floatBounds) {
+  // Replays draws with all the converted bits set, which round up to _max
+  //  without clamping.
+  const u64 kOnes = U64_MAX;
+  std::string path = testing::TempDir() + "rnd_float_bounds.bin";
+  {
+    rnd::TraceWriter writer(path, 16);
+    for (u64 idx = 0; idx < 16; idx++) {
+      writer.write(kOnes);
+    }
+  }
+  rnd::TraceReader reader(path);
+  rnd::Random rand(&reader);
+
+  ASSERT_LT(rand.nextF32(10.0f, 20.0f), 20.0f);
+  ASSERT_LT(rand.nextF32(10.0f, 20.0f), 20.0f);
+  ASSERT_LT(rand.nextF64(10.0, 20.0), 20.0);
+  f32 f32s[4];
+  rand.fillF32(f32s, 4, 10.0f, 20.0f);
+  for (f32 value : f32s) {
+    ASSERT_EQ(value, std::nextafter(20.0f, 10.0f));
+  }
+  f64 f64s[4];
+  rand.fillF64(f64s, 4, 1e6, 1e6 + 1.0);
+  for (f64 value : f64s) {
+    ASSERT_LT(value, 1e6 + 1.0);
+  }
+  ASSERT_EQ(rand.nextF32(5.0f, 5.0f), 5.0f);
+}
@@ -0,0 +1,151 @@
+/*
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * - Redistributions of source code must retain the above copyright notice, this
+ * list of conditions and the following disclaimer.
+ *
+ * - Redistributions in binary form must reproduce the above copyright notice,
+ * this list of conditions and the following disclaimer in the documentation
+ * and/or other materials provided with the distribution.
+ *
+ * - Neither the name of prim nor the names of its contributors may be used to
+ * endorse or promote products derived from this software without specific prior
+ * written permission.
+ *
+ * See the NOTICE file distributed with this work for additional information
+ * regarding copyright ownership.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ */
+#include "rnd/Trace.h"
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include <cassert>
+#include <cerrno>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+
+namespace rnd {
+
+namespace {
+
+// this reports the failed operation with the current errno and aborts
+[[noreturn]] void fail(const char* _operation, const std::string& _path) {
+  fprintf(stderr, "rnd: trace %s failed for '%s': %s\n", _operation,
+          _path.c_str(), strerror(errno));
+  abort();
+}
+
+// this opens the file, retrying if interrupted by a signal
+int openFile(const std::string& _path, int _flags) {
+  while (true) {
+    int fd = open(_path.c_str(), _flags, 0644);
+    if (fd >= 0) {
+      return fd;
+    }
+    if (errno != EINTR) {
+      fail("open", _path);
+    }
+  }
+}
+
+}  // namespace
+
+TraceWriter::TraceWriter(const std::string& _path, u64 _chunkSize)
+    : path_(_path), count_(0) {
+  assert(_chunkSize > 0);
+  fd_ = openFile(path_, O_WRONLY | O_CREAT | O_TRUNC);
+  buffer_.reserve(_chunkSize);
+}
+
+TraceWriter::~TraceWriter() {
+  flush();
+  if (close(fd_) != 0 && errno != EINTR) {
+    fail("close", path_);
+  }
+}
+
+void TraceWriter::write(u64 _value) {
+  buffer_.push_back(_value);
+  count_++;
+  if (buffer_.size() == buffer_.capacity()) {
+    flush();
+  }
+}
+
+void TraceWriter::flush() {
+  const char* bytes = reinterpret_cast<const char*>(buffer_.data());
+  u64 remaining = buffer_.size() * sizeof(u64);
+  while (remaining > 0) {
+    ssize_t written = ::write(fd_, bytes, remaining);
+    if (written < 0) {
+      if (errno == EINTR) {
+        continue;
+      }
+      fail("write", path_);
+    }
+    bytes += written;
+    remaining -= written;
+  }
+  buffer_.clear();
+}
+
+u64 TraceWriter::count() const {
+  return count_;
+}
+
+TraceReader::TraceReader(const std::string& _path)
+    : data_(nullptr), size_(0) {
+  int fd = openFile(_path, O_RDONLY);
+  struct stat info;
+  if (fstat(fd, &info) != 0) {
+    fail("stat", _path);
+  }
+  if (info.st_size % sizeof(u64) != 0) {
+    fprintf(stderr, "rnd: trace '%s' is %ld bytes, not a whole number of "
+            "values\n", _path.c_str(), static_cast<s64>(info.st_size));
+    abort();
+  }
+  size_ = info.st_size / sizeof(u64);
+  if (size_ > 0) {
+    void* addr = mmap(nullptr, size_ * sizeof(u64), PROT_READ, MAP_PRIVATE,
+                      fd, 0);
+    if (addr == MAP_FAILED) {
+      fail("mmap", _path);
+    }
+    madvise(addr, size_ * sizeof(u64), MADV_SEQUENTIAL);
+    data_ = static_cast<const u64*>(addr);
+  }
+  close(fd);
+}
+TraceReader::~TraceReader() {
+  if (data_ != nullptr) {
+    munmap(const_cast<u64*>(data_), size_ * sizeof(u64));
+  }
+}
+
+const u64* TraceReader::data() const {
+  return data_;
+}
+
+u64 TraceReader::size() const {
+  return size_;
+}
+
+}  // namespace rnd
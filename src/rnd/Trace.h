@@ -0,0 +1,82 @@
+/*
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * - Redistributions of source code must retain the above copyright notice, this
+ * list of conditions and the following disclaimer.
+ *
+ * - Redistributions in binary form must reproduce the above copyright notice,
+ * this list of conditions and the following disclaimer in the documentation
+ * and/or other materials provided with the distribution.
+ *
+ * - Neither the name of prim nor the names of its contributors may be used to
+ * endorse or promote products derived from this software without specific prior
+ * written permission.
+ *
+ * See the NOTICE file distributed with this work for additional information
+ * regarding copyright ownership.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ */
+#ifndef RND_TRACE_H_
+#define RND_TRACE_H_
+
+#include <prim/prim.h>
+
+#include <string>
+#include <vector>
+
+namespace rnd {
+
+// a trace file is the sequence of raw 64-bit engine outputs consumed by a
+//  Random, stored in native byte order with no header. I/O errors print the
+//  system error and abort
+
+// this streams raw engine outputs to a trace file in large buffered chunks,
+//  attach it to a Random with Random::record()
+class TraceWriter {
+ public:
+  TraceWriter(const std::string& _path, u64 _chunkSize);
+  ~TraceWriter();  // this flushes the buffer and closes the file
+  TraceWriter(const TraceWriter&) = delete;
+  TraceWriter& operator=(const TraceWriter&) = delete;
+  void write(u64 _value);
+  void flush();
+  u64 count() const;  // the number of values written so far
+
+ private:
+  std::string path_;
+  int fd_;
+  std::vector<u64> buffer_;
+  u64 count_;
+};
+
+// this maps a trace file into memory, construct a Random from it to replay
+//  the recorded draws
+class TraceReader {
+ public:
+  explicit TraceReader(const std::string& _path);
+  ~TraceReader();
+  TraceReader(const TraceReader&) = delete;
+  TraceReader& operator=(const TraceReader&) = delete;
+  const u64* data() const;
+  u64 size() const;  // the number of values in the trace
+
+ private:
+  const u64* data_;
+  u64 size_;
+};
+
+}  // namespace rnd
+
+#endif  // RND_TRACE_H_
@@ -0,0 +1,216 @@
+/*
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * - Redistributions of source code must retain the above copyright notice, this
+ * list of conditions and the following disclaimer.
+ *
+ * - Redistributions in binary form must reproduce the above copyright notice,
+ * this list of conditions and the following disclaimer in the documentation
+ * and/or other materials provided with the distribution.
+ *
+ * - Neither the name of prim nor the names of its contributors may be used to
+ * endorse or promote products derived from this software without specific prior
+ * written permission.
+ *
+ * See the NOTICE file distributed with this work for additional information
+ * regarding copyright ownership.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ */
+#include "rnd/Trace.h"
+
+#include <cstdio>
+#include <string>
+#include <vector>
+
+#include "gtest/gtest.h"
+#include "prim/prim.h"
+#include "rnd/Random.h"
+
+namespace {
+
+// Draws a mix of values, including ones that consume a variable number of
+//  raw values.
+std::vector<f64> draw(rnd::Random* _rand, u64 _rounds) {
+  std::vector<f64> values;
+  std::vector<u32> shuffled({1, 2, 3, 4, 5, 6, 7, 8});
+  for (u64 r = 0; r < _rounds; r++) {
+    values.push_back(_rand->nextU64());
+    values.push_back(_rand->nextU64(3, 3 + r));
+    values.push_back(_rand->nextF64());
+    values.push_back(_rand->nextF32());
+    values.push_back(_rand->nextBinomial(1000, 0.3));
+    _rand->shuffle(&shuffled);
+    values.push_back(shuffled.front());
+  }
+  return values;
+}
+
+}  // namespace
+
+TEST(Trace, recordReplay) {
+  const u64 kRounds = 10000;
+  for (rnd::Random::Engine engine : {rnd::Random::Engine::kMt19937,
+                                     rnd::Random::Engine::kXoshiro256}) {
+    std::string path = testing::TempDir() + "rnd_trace_test.bin";
+
+    // Records a stream of draws.
+    rnd::Random rand(1234, engine);
+    std::vector<f64> exp;
+    u64 count;
+    {
+      rnd::TraceWriter writer(path, 1000);
+      rand.record(&writer);
+      exp = draw(&rand, kRounds);
+      rand.record(nullptr);
+      count = writer.count();
+    }
+    ASSERT_GT(count, kRounds);
+
+    // Verifies the values after recording stopped aren't in the trace.
+    rand.nextU64();
+
+    // Replays the draws twice, rewinding in between.
+    rnd::TraceReader reader(path);
+    ASSERT_EQ(reader.size(), count);
+    rnd::Random replay(&reader);
+    ASSERT_EQ(replay.engine(), rnd::Random::Engine::kReplay);
+    ASSERT_EQ(draw(&replay, kRounds), exp);
+    replay.seed(0);
+    ASSERT_EQ(draw(&replay, kRounds), exp);
+
+    // Verifies the raw values match the engine's own stream.
+    rnd::Random source(1234, engine);
+    for (u64 idx = 0; idx < reader.size(); idx++) {
+      ASSERT_EQ(reader.data()[idx], source.nextU64());
+    }
+  }
+}
+
+TEST(Trace, empty) {
+  std::string path = testing::TempDir() + "rnd_trace_empty.bin";
+  { rnd::TraceWriter writer(path, 16); }
+  rnd::TraceReader reader(path);
+  ASSERT_EQ(reader.size(), 0u);
+}
+
+TEST(Trace, reattach) {
+  std::string path = testing::TempDir() + "rnd_trace_reattach.bin";
+  rnd::Random rand(1234);
+  rnd::Random source(1234);
+  std::vector<u64> exp;
+  {
+    rnd::TraceWriter writer(path, 4);
+    rand.record(&writer);
+    for (u64 r = 0; r < 10; r++) {
+      exp.push_back(rand.nextU64());
+    }
+
+    // Verifies draws made while detached aren't recorded.
+    rand.record(nullptr);
+    for (u64 r = 0; r < 7; r++) {
+      rand.nextU64();
+    }
+    ASSERT_EQ(writer.count(), 10u);
+
+    rand.record(&writer);
+    for (u64 r = 0; r < 5; r++) {
+      exp.push_back(rand.nextU64());
+    }
+    rand.record(nullptr);
+    ASSERT_EQ(writer.count(), 15u);
+  }
+
+  // Verifies the trace holds both recorded segments with the gap skipped.
+  rnd::TraceReader reader(path);
+  ASSERT_EQ(reader.size(), 15u);
+  for (u64 idx = 0; idx < 10; idx++) {
+    ASSERT_EQ(reader.data()[idx], source.nextU64());
+  }
+  for (u64 r = 0; r < 7; r++) {
+    source.nextU64();
+  }
+  for (u64 idx = 10; idx < 15; idx++) {
+    ASSERT_EQ(reader.data()[idx], source.nextU64());
+  }
+  rnd::Random replay(&reader);
+  for (u64 idx = 0; idx < 15; idx++) {
+    ASSERT_EQ(replay.nextU64(), exp.at(idx));
+  }
+}
+
+TEST(Trace, copyNotRecorded) {
+  std::string path = testing::TempDir() + "rnd_trace_copy.bin";
+  rnd::Random rand(1234);
+  std::vector<u64> exp;
+  {
+    rnd::TraceWriter writer(path, 16);
+    rand.record(&writer);
+    exp.push_back(rand.nextU64());
+
+    // Verifies the forked copies draw without writing to the trace.
+    rnd::Random fork1(rand);
+    rnd::Random fork2(99);
+    fork2 = rand;
+    fork1.nextU64();
+    fork2.nextU64();
+    fork2.nextU64();
+    exp.push_back(rand.nextU64());
+    ASSERT_EQ(writer.count(), 2u);
+
+    // Verifies a copy can record its own stream.
+    fork1.record(&writer);
+    fork1.nextU64();
+    ASSERT_EQ(writer.count(), 3u);
+  }
+  rnd::TraceReader reader(path);
+  ASSERT_EQ(reader.size(), 3u);
+  ASSERT_EQ(reader.data()[0], exp.at(0));
+  ASSERT_EQ(reader.data()[1], exp.at(1));
+}
+
+TEST(TraceDeathTest, exhausted) {
+  std::string path = testing::TempDir() + "rnd_trace_exhausted.bin";
+  {
+    rnd::TraceWriter writer(path, 16);
+    rnd::Random rand(1234);
+    rand.record(&writer);
+    for (u64 r = 0; r < 3; r++) {
+      rand.nextU64();
+    }
+  }
+  rnd::TraceReader reader(path);
+  rnd::Random replay(&reader);
+  for (u64 r = 0; r < 3; r++) {
+    replay.nextU64();
+  }
+  ASSERT_DEATH(replay.nextU64(), "trace exhausted after 3 values");
+}
+
+TEST(TraceDeathTest, truncated) {
+  // Writes a trace cut off in the middle of a value.
+  std::string path = testing::TempDir() + "rnd_trace_truncated.bin";
+  FILE* file = fopen(path.c_str(), "wb");
+  ASSERT_NE(file, nullptr);
+  const char kBytes[12] = {0};
+  ASSERT_EQ(fwrite(kBytes, 1, sizeof(kBytes), file), sizeof(kBytes));
+  fclose(file);
+  ASSERT_DEATH(rnd::TraceReader reader(path), "not a whole number of values");
+}
+
+TEST(TraceDeathTest, missing) {
+  std::string path = testing::TempDir() + "rnd_trace_missing/none.bin";
+  ASSERT_DEATH(rnd::TraceReader reader(path), "open failed");
+  ASSERT_DEATH(rnd::TraceWriter writer(path, 16), "open failed");
+}
@@ -0,0 +1,126 @@
+/*
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * - Redistributions of source code must retain the above copyright notice, this
+ * list of conditions and the following disclaimer.
+ *
+ * - Redistributions in binary form must reproduce the above copyright notice,
+ * this list of conditions and the following disclaimer in the documentation
+ * and/or other materials provided with the distribution.
+ *
+ * - Neither the name of prim nor the names of its contributors may be used to
+ * endorse or promote products derived from this software without specific prior
+ * written permission.
+ *
+ * See the NOTICE file distributed with this work for additional information
+ * regarding copyright ownership.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ */
+#include "rnd/ZipfSampler.h"
+
+#include <cassert>
+#include <cmath>
+
+namespace rnd {
+
+namespace {
+
+// this returns log(1+x)/x, accurate near 0
+f64 helper1(f64 _x) {
+  if (std::abs(_x) > 1e-8) {
+    return std::log1p(_x) / _x;
+  }
+  return 1.0 - _x * (0.5 - _x * (1.0 / 3.0 - 0.25 * _x));
+}
+
+// this returns (exp(x)-1)/x, accurate near 0
+f64 helper2(f64 _x) {
+  if (std::abs(_x) > 1e-8) {
+    return std::expm1(_x) / _x;
+  }
+  return 1.0 + _x * 0.5 * (1.0 + _x * (1.0 / 3.0) * (1.0 + 0.25 * _x));
+}
+
+}  // namespace
+
+ZipfSampler::ZipfSampler(Random* _random, u64 _numElements, f64 _exponent)
+    : random_(_random), numElements_(_numElements), exponent_(_exponent) {
+  assert(_numElements > 0);
+  assert(_exponent >= 0);
+  hIntegralX1_ = hIntegral(1.5) - 1.0;
+  hIntegralNumElements_ = hIntegral(numElements_ + 0.5);
+  s_ = 2.0 - hIntegralInverse(hIntegral(2.5) - h(2.0));
+}
+
+ZipfSampler::~ZipfSampler() {}
+
+u64 ZipfSampler::numElements() const {
+  return numElements_;
+}
+
+f64 ZipfSampler::exponent() const {
+  return exponent_;
+}
+
+u64 ZipfSampler::sample() {
+  while (true) {
+    // draws uniformly from the area under the hat function, then maps it
+    //  back to the nearest rank
+    f64 u = hIntegralNumElements_ +
+            random_->nextF64() * (hIntegralX1_ - hIntegralNumElements_);
+    f64 x = hIntegralInverse(u);
+    u64 k;
+    if (x < 1.5) {
+      k = 1;
+    } else if (x >= numElements_) {
+      k = numElements_;
+    } else {
+      k = static_cast<u64>(x + 0.5);
+    }
+
+    // accepts if the point lies under the true probability mass
+    if (k - x <= s_ || u >= hIntegral(k + 0.5) - h(k)) {
+      return k;
+    }
+  }
+}
+
+void ZipfSampler::sample(u64* _values, u64 _count) {
+  for (u64 idx = 0; idx < _count; idx++) {
+    _values[idx] = sample();
+  }
+}
+
+// this is the hat function, 1/x^exponent
+f64 ZipfSampler::h(f64 _x) const {
+  return std::exp(-exponent_ * std::log(_x));
+}
+
+// this is the integral of h(x), (x^(1-exponent)-1)/(1-exponent)
+f64 ZipfSampler::hIntegral(f64 _x) const {
+  f64 logX = std::log(_x);
+  return helper2((1.0 - exponent_) * logX) * logX;
+}
+
+// this is the inverse of hIntegral(x)
+f64 ZipfSampler::hIntegralInverse(f64 _x) const {
+  f64 t = _x * (1.0 - exponent_);
+  if (t < -1.0) {
+    t = -1.0;
+  }
+  return std::exp(helper1(t) * _x);
+}
+
+}  // namespace rnd
@@ -0,0 +1,67 @@
+/*
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * - Redistributions of source code must retain the above copyright notice, this
+ * list of conditions and the following disclaimer.
+ *
+ * - Redistributions in binary form must reproduce the above copyright notice,
+ * this list of conditions and the following disclaimer in the documentation
+ * and/or other materials provided with the distribution.
+ *
+ * - Neither the name of prim nor the names of its contributors may be used to
+ * endorse or promote products derived from this software without specific prior
+ * written permission.
+ *
+ * See the NOTICE file distributed with this work for additional information
+ * regarding copyright ownership.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ */
+#ifndef RND_ZIPFSAMPLER_H_
+#define RND_ZIPFSAMPLER_H_
+
+#include "prim/prim.h"
+#include "rnd/Random.h"
+
+namespace rnd {
+
+// this samples ranks in [1,_numElements] where rank k has probability
+//  proportional to 1/k^_exponent, it uses the rejection-inversion method of
+//  Hormann and Derflinger which takes O(1) expected time and O(1) memory
+//  regardless of the number of elements
+class ZipfSampler {
+ public:
+  ZipfSampler(Random* _random, u64 _numElements, f64 _exponent);
+  ~ZipfSampler();
+  u64 numElements() const;
+  f64 exponent() const;
+  u64 sample();
+  void sample(u64* _values, u64 _count);
+
+ private:
+  f64 h(f64 _x) const;
+  f64 hIntegral(f64 _x) const;
+  f64 hIntegralInverse(f64 _x) const;
+
+  Random* random_;
+  u64 numElements_;
+  f64 exponent_;
+  f64 hIntegralX1_;
+  f64 hIntegralNumElements_;
+  f64 s_;
+};
+
+}  // namespace rnd
+
+#endif  // RND_ZIPFSAMPLER_H_
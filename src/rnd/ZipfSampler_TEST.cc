@@ -0,0 +1,101 @@
+/*
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * - Redistributions of source code must retain the above copyright notice, this
+ * list of conditions and the following disclaimer.
+ *
+ * - Redistributions in binary form must reproduce the above copyright notice,
+ * this list of conditions and the following disclaimer in the documentation
+ * and/or other materials provided with the distribution.
+ *
+ * - Neither the name of prim nor the names of its contributors may be used to
+ * endorse or promote products derived from this software without specific prior
+ * written permission.
+ *
+ * See the NOTICE file distributed with this work for additional information
+ * regarding copyright ownership.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ */
+#include "rnd/ZipfSampler.h"
+
+#include <cmath>
+#include <vector>
+
+#include "gtest/gtest.h"
+#include "prim/prim.h"
+#include "rnd/Random.h"
+
+TEST(ZipfSampler, distribution) {
+  const u64 kElements = 20;
+  const u64 kRounds = 2000000;
+  const std::vector<f64> kExponents({0.0, 0.5, 1.0, 1.2, 2.5});
+  for (f64 exponent : kExponents) {
+    rnd::Random rand(0xDEADBEEF12345678lu);
+    rnd::ZipfSampler zipf(&rand, kElements, exponent);
+    ASSERT_EQ(zipf.numElements(), kElements);
+    ASSERT_EQ(zipf.exponent(), exponent);
+
+    std::vector<u64> counts(kElements + 1, 0);
+    for (u64 r = 0; r < kRounds; r++) {
+      u64 k = zipf.sample();
+      ASSERT_GE(k, 1u);
+      ASSERT_LE(k, kElements);
+      counts.at(k)++;
+    }
+
+    f64 norm = 0;
+    for (u64 k = 1; k <= kElements; k++) {
+      norm += std::pow(k, -exponent);
+    }
+    for (u64 k = 1; k <= kElements; k++) {
+      f64 exp_ratio = std::pow(k, -exponent) / norm;
+      f64 act_ratio = static_cast<f64>(counts.at(k)) / kRounds;
+      ASSERT_NEAR(act_ratio, exp_ratio, 0.002);
+    }
+  }
+}
+
+TEST(ZipfSampler, single) {
+  rnd::Random rand(1234);
+  rnd::ZipfSampler zipf(&rand, 1, 1.0);
+  for (u64 r = 0; r < 1000; r++) {
+    ASSERT_EQ(zipf.sample(), 1u);
+  }
+}
+
+TEST(ZipfSampler, bulk) {
+  const u64 kElements = 1000000000;
+  const u64 kCount = 100000;
+
+  // Verifies the bulk draw matches the single draw for the same seed.
+  rnd::Random rand1(1234);
+  rnd::Random rand2(1234);
+  rnd::ZipfSampler zipf1(&rand1, kElements, 0.99);
+  rnd::ZipfSampler zipf2(&rand2, kElements, 0.99);
+  std::vector<u64> values(kCount);
+  zipf1.sample(values.data(), kCount);
+  u64 ones = 0;
+  for (u64 idx = 0; idx < kCount; idx++) {
+    ASSERT_EQ(values.at(idx), zipf2.sample());
+    ASSERT_GE(values.at(idx), 1u);
+    ASSERT_LE(values.at(idx), kElements);
+    if (values.at(idx) == 1) {
+      ones++;
+    }
+  }
+
+  // Rank 1 has probability ~0.046 for this domain and exponent.
+  ASSERT_NEAR(static_cast<f64>(ones) / kCount, 0.046, 0.005);
+}